@@ -2,23 +2,223 @@
 #include <winhttp.h>
 #pragma comment(lib, "winhttp.lib")
 
+#include <bit>
 #include <cstdio>
 #include <cstdlib>
 #include <cwchar>
 #include <format>
 
-constexpr const wchar_t DEFAULT_USER_AGENT[] = L"Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/110.0.0.0 Safari/537.36 Edg/110.0.1587.50";
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WIN_HTTP_USE_SSE2 1
+#endif
+
+constexpr const char DEFAULT_USER_AGENT[] = "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/110.0.0.0 Safari/537.36 Edg/110.0.1587.50";
+
+static_assert(sizeof(wchar_t) == sizeof(uint16_t), "WinHTTP expects UTF-16 wchar_t");
+
+constexpr wchar_t REPLACEMENT_CHAR = 0xFFFD;
+
+/// Encoding
+
+wstring utf8_to_utf16(string_view input) {
+    // A UTF-8 sequence never yields more UTF-16 units than it has bytes
+    wstring output(input.size(), L'\0');
+
+    const auto* src = reinterpret_cast<const uint8_t*>(input.data());
+    const size_t src_size = input.size();
+    wchar_t* dst = output.data();
+    size_t i = 0;
+    size_t j = 0;
+
+#ifdef WIN_HTTP_USE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+#endif
+    // Only retry the fast path after an ASCII byte, so non-ASCII runs stay scalar
+    bool try_simd = true;
+
+    while (i < src_size) {
+#ifdef WIN_HTTP_USE_SSE2
+        // ASCII fast path: widen 16 bytes at a time
+        while (try_simd && i + 16 <= src_size) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            const int non_ascii_bits = _mm_movemask_epi8(chunk);
+            if (non_ascii_bits != 0) {
+                // Copy the ASCII prefix of this chunk, the scalar decoder starts at the first non-ASCII byte
+                const int ascii_prefix = std::countr_zero(static_cast<unsigned>(non_ascii_bits));
+                for (int k = 0; k < ascii_prefix; ++k) {
+                    dst[j++] = src[i++];
+                }
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + j), _mm_unpacklo_epi8(chunk, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + j + 8), _mm_unpackhi_epi8(chunk, zero));
+            i += 16;
+            j += 16;
+        }
+        if (i >= src_size) {
+            break;
+        }
+#endif
+
+        const uint8_t lead = src[i];
+        if (lead < 0x80) {
+            dst[j++] = lead;
+            ++i;
+            try_simd = true;
+            continue;
+        }
+        try_simd = false;
+
+        size_t extra = 0;
+        uint32_t code_point = 0;
+        uint32_t min_code_point = 0;
+        if ((lead & 0xE0) == 0xC0) {
+            extra = 1;
+            code_point = lead & 0x1F;
+            min_code_point = 0x80;
+        } else if ((lead & 0xF0) == 0xE0) {
+            extra = 2;
+            code_point = lead & 0x0F;
+            min_code_point = 0x800;
+        } else if ((lead & 0xF8) == 0xF0) {
+            extra = 3;
+            code_point = lead & 0x07;
+            min_code_point = 0x10000;
+        } else {
+            dst[j++] = REPLACEMENT_CHAR;
+            ++i;
+            continue;
+        }
+
+        bool valid = i + extra < src_size;
+        for (size_t k = 1; valid && k <= extra; ++k) {
+            const uint8_t ch = src[i + k];
+            if ((ch & 0xC0) != 0x80) {
+                valid = false;
+            } else {
+                code_point = (code_point << 6) | (ch & 0x3F);
+            }
+        }
+        if (!valid || code_point < min_code_point || code_point > 0x10FFFF
+            || (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+            dst[j++] = REPLACEMENT_CHAR;
+            ++i;
+            continue;
+        }
+
+        if (code_point >= 0x10000) {
+            code_point -= 0x10000;
+            dst[j++] = static_cast<wchar_t>(0xD800 + (code_point >> 10));
+            dst[j++] = static_cast<wchar_t>(0xDC00 + (code_point & 0x3FF));
+        } else {
+            dst[j++] = static_cast<wchar_t>(code_point);
+        }
+        i += extra + 1;
+    }
+
+    output.resize(j);
+    return output;
+}
+
+
+string utf16_to_utf8(wstring_view input) {
+    // A UTF-16 unit never yields more than 3 UTF-8 bytes (a surrogate pair yields 4 from 2 units)
+    string output(input.size() * 3, '\0');
+
+    const wchar_t* src = input.data();
+    const size_t src_size = input.size();
+    char* dst = output.data();
+    size_t i = 0;
+    size_t j = 0;
+
+#ifdef WIN_HTTP_USE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i non_ascii_mask = _mm_set1_epi16(static_cast<short>(0xFF80));
+#endif
+    // Only retry the fast path after an ASCII unit, so non-ASCII runs stay scalar
+    bool try_simd = true;
+
+    while (i < src_size) {
+#ifdef WIN_HTTP_USE_SSE2
+        // ASCII fast path: narrow 16 units at a time
+        while (try_simd && i + 16 <= src_size) {
+            const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+            const __m128i ascii_low = _mm_cmpeq_epi16(_mm_and_si128(low, non_ascii_mask), zero);
+            const __m128i ascii_high = _mm_cmpeq_epi16(_mm_and_si128(high, non_ascii_mask), zero);
+            const int ascii_bits = _mm_movemask_epi8(_mm_packs_epi16(ascii_low, ascii_high));
+            if (ascii_bits != 0xFFFF) {
+                // Copy the ASCII prefix of this chunk, the scalar encoder starts at the first non-ASCII unit
+                const int ascii_prefix = std::countr_one(static_cast<unsigned>(ascii_bits));
+                for (int k = 0; k < ascii_prefix; ++k) {
+                    dst[j++] = static_cast<char>(src[i++]);
+                }
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + j), _mm_packus_epi16(low, high));
+            i += 16;
+            j += 16;
+        }
+        if (i >= src_size) {
+            break;
+        }
+#endif
+
+        uint32_t code_point = static_cast<uint16_t>(src[i++]);
+        if (code_point >= 0xD800 && code_point <= 0xDBFF && i < src_size
+            && static_cast<uint16_t>(src[i]) >= 0xDC00 && static_cast<uint16_t>(src[i]) <= 0xDFFF) {
+            code_point = 0x10000 + ((code_point - 0xD800) << 10) + (static_cast<uint16_t>(src[i++]) - 0xDC00);
+        } else if (code_point >= 0xD800 && code_point <= 0xDFFF) {
+            code_point = REPLACEMENT_CHAR;
+        }
+
+        try_simd = code_point < 0x80;
+        if (code_point < 0x80) {
+            dst[j++] = static_cast<char>(code_point);
+        } else if (code_point < 0x800) {
+            dst[j++] = static_cast<char>(0xC0 | (code_point >> 6));
+            dst[j++] = static_cast<char>(0x80 | (code_point & 0x3F));
+        } else if (code_point < 0x10000) {
+            dst[j++] = static_cast<char>(0xE0 | (code_point >> 12));
+            dst[j++] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+            dst[j++] = static_cast<char>(0x80 | (code_point & 0x3F));
+        } else {
+            dst[j++] = static_cast<char>(0xF0 | (code_point >> 18));
+            dst[j++] = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+            dst[j++] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+            dst[j++] = static_cast<char>(0x80 | (code_point & 0x3F));
+        }
+    }
+
+    output.resize(j);
+    return output;
+}
+
+
+string build_request_header(const string& url, const string& body, const string& extra_header) {
+    string header;
+    if (body.length() > 0) {
+        header = std::format("Content-Length: {}\r\n", body.length());
+    }
+    if (extra_header == "" || extra_header.find("Content-Type: application/json") == -1) {
+        header += "Content-Type: application/x-www-form-urlencoded\r\n";
+    }
+    header += std::format("Referer: {}\r\n", url);
+    header += extra_header + "\r\n";
+    return header;
+}
 
 /// HttpResponse
 
-HttpResponse::HttpResponse() : text(""), header(L""), error(""),
+HttpResponse::HttpResponse() : text(""), header(""), error(""),
 status_code(0), content_length(0),
 _header_record({ }) { }
 
 
 void HttpResponse::reset() {
     text = "";
-    header = L"";
+    header = "";
     status_code = 0;
     error = "";
     _header_record.clear();
@@ -34,19 +234,19 @@ HeaderRecord& HttpResponse::header_record() {
     bool return_carriage_reached = false;
     bool colon_reached = false;
     bool colon_just_reached = false;
-    std::wstring key;
-    std::wstring value;
+    std::string key;
+    std::string value;
     for (size_t i = 0; i < header.size(); ++i) {
-        const wchar_t ch = header.at(i);
-        if (ch == L':') {
+        const char ch = header.at(i);
+        if (ch == ':') {
             colon_reached = true;
             colon_just_reached = true;
             continue;
-        } else if (ch == L'\r') {
+        } else if (ch == '\r') {
             return_carriage_reached = true;
-        } else if (ch == L'\n' && !return_carriage_reached) {
+        } else if (ch == '\n' && !return_carriage_reached) {
             return_carriage_reached = true;
-        } else if (ch == L'\n' && return_carriage_reached) {
+        } else if (ch == '\n' && return_carriage_reached) {
             return_carriage_reached = false;
             continue;
         }
@@ -59,7 +259,7 @@ HeaderRecord& HttpResponse::header_record() {
             key.clear();
             value.clear();
             colon_reached = false;
-            if (ch == L'\n') {
+            if (ch == '\n') {
                 return_carriage_reached = false;
             }
 
@@ -71,7 +271,7 @@ HeaderRecord& HttpResponse::header_record() {
         } else {
             if (colon_just_reached) {
                 colon_just_reached = false;
-                if (ch == L' ') {
+                if (ch == ' ') {
                     continue;
                 }
             }
@@ -87,16 +287,16 @@ HeaderRecord& HttpResponse::header_record() {
 }
 
 
-wstring HttpResponse::cookies() {
-    wstring result = L"Cookie: ";
+string HttpResponse::cookies() {
+    string result = "Cookie: ";
 
     auto header_copy = header;
-    wregex pattern(L"Set-Cookie: (.*)");
-    std::pmr::wsmatch match;
+    regex pattern("Set-Cookie: (.*)");
+    std::smatch match;
 
     while (std::regex_search(header_copy, match, pattern)) {
         result += match[1];
-        result += L"; ";
+        result += "; ";
         header_copy = match.suffix();
     }
 
@@ -107,17 +307,17 @@ wstring HttpResponse::cookies() {
 
 
 HttpClient::HttpClient(bool_t use_proxy) noexcept : _use_proxy(use_proxy), _proxy_host(L""), _proxy_username(L""), _proxy_password(L""),
-_user_agent(DEFAULT_USER_AGENT), _check_valid_ssl(FALSE), _last_error_code(0),
+_user_agent(utf8_to_utf16(DEFAULT_USER_AGENT)), _check_valid_ssl(FALSE), _last_error_code(0),
 _resolve_timeout(0), _connect_timeout(60000), _send_timeout(30000), _receive_timeout(30000) { }
 
 
 HttpClient::~HttpClient() noexcept { }
 
 
-void HttpClient::set_proxy(const wstring& proxy_host, const wstring& proxy_username, const wstring& proxy_password) {
-    _proxy_host = proxy_host;
-    _proxy_username = proxy_username;
-    _proxy_password = proxy_password;
+void HttpClient::set_proxy(const string& proxy_host, const string& proxy_username, const string& proxy_password) {
+    _proxy_host = utf8_to_utf16(proxy_host);
+    _proxy_username = utf8_to_utf16(proxy_username);
+    _proxy_password = utf8_to_utf16(proxy_password);
 }
 
 
@@ -126,8 +326,8 @@ void HttpClient::set_use_proxy(bool_t use_proxy) {
 }
 
 
-void HttpClient::set_user_agent(const wstring& user_agent) {
-    _user_agent = user_agent;
+void HttpClient::set_user_agent(const string& user_agent) {
+    _user_agent = utf8_to_utf16(user_agent);
 }
 
 
@@ -136,7 +336,7 @@ int HttpClient::last_error() {
 }
 
 
-HttpResponse HttpClient::request(const wstring& method, const wstring& url, const string& body, const wstring& extra_header) {
+HttpResponse HttpClient::request(const string& method, const string& url, const string& body, const string& extra_header) {
     HttpResponse response;
 
     HINTERNET session_handle = nullptr;
@@ -144,16 +344,20 @@ HttpResponse HttpClient::request(const wstring& method, const wstring& url, cons
     HINTERNET request_handle = nullptr;
 
     // 检查 url
-    if (url == L"") {
+    if (url == "") {
         _last_error_code = ERROR_PATH_NOT_FOUND;
         return response;
     }
 
-    if (method == L"") {
+    if (method == "") {
         _last_error_code = ERROR_INVALID_PARAMETER;
         return response;
     }
 
+    // WinHTTP only speaks UTF-16, convert once here
+    const wstring wide_method = utf8_to_utf16(method);
+    const wstring wide_url = utf8_to_utf16(url);
+
     session_handle = WinHttpOpen(_user_agent.c_str(),
         WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
         WINHTTP_NO_PROXY_NAME,
@@ -180,7 +384,7 @@ HttpResponse HttpClient::request(const wstring& method, const wstring& url, cons
     url_comp.dwSchemeLength = 1; // None zero
 
     try {
-        if (!WinHttpCrackUrl(url.c_str(), url.length(), 0, &url_comp)) {
+        if (!WinHttpCrackUrl(wide_url.c_str(), wide_url.length(), 0, &url_comp)) {
             throw std::runtime_error("WinHttpCrackUrl Failed!");
         }
 
@@ -192,7 +396,7 @@ HttpResponse HttpClient::request(const wstring& method, const wstring& url, cons
 
         const dword_t open_request_flag = (url_comp.nScheme == INTERNET_SCHEME_HTTPS) ? WINHTTP_FLAG_SECURE : 0;
         request_handle = WinHttpOpenRequest(connect_handle,
-            method.c_str(),
+            wide_method.c_str(),
             url_comp.lpszUrlPath,
             nullptr,
             WINHTTP_NO_REFERER,
@@ -221,17 +425,8 @@ HttpResponse HttpClient::request(const wstring& method, const wstring& url, cons
             const_cast<dword_t*>(&options),
             sizeof(dword_t));
 
-        wstring header;
-        if (body.length() > 0) {
-            header = std::format(L"Content-Length: {}\r\n", body.length());
-        }
-        if (extra_header == L"" || extra_header.find(L"Content-Type: application/json") == -1) {
-            header += L"Content-Type: application/x-www-form-urlencoded\r\n";
-        }
-        header += std::format(L"Referer: {}\r\n", url);
-        header += extra_header + L"\r\n";
-
-        if (!WinHttpAddRequestHeaders(request_handle, header.c_str(), header.length(), WINHTTP_ADDREQ_FLAG_COALESCE_WITH_SEMICOLON)) {
+        const wstring wide_header = utf8_to_utf16(build_request_header(url, body, extra_header));
+        if (!WinHttpAddRequestHeaders(request_handle, wide_header.c_str(), wide_header.length(), WINHTTP_ADDREQ_FLAG_COALESCE_WITH_SEMICOLON)) {
             _last_error_code = GetLastError();
         }
 
@@ -243,11 +438,11 @@ HttpResponse HttpClient::request(const wstring& method, const wstring& url, cons
             if (!WinHttpSetOption(request_handle, WINHTTP_OPTION_PROXY, &proxy_info, sizeof(proxy_info))) {
                 _last_error_code = GetLastError();
             }
-            if (_proxy_username != L"") {
+            if (!_proxy_username.empty()) {
                 if (!WinHttpSetOption(request_handle, WINHTTP_OPTION_PROXY_USERNAME, const_cast<wchar_t*>(_proxy_username.c_str()), _proxy_username.length())) {
                     _last_error_code = GetLastError();
                 }
-                if (_proxy_password != L"") {
+                if (!_proxy_password.empty()) {
                     if (!WinHttpSetOption(request_handle, WINHTTP_OPTION_PROXY_PASSWORD, const_cast<wchar_t*>(_proxy_password.c_str()), _proxy_password.length())) {
                         _last_error_code = GetLastError();
                     }
@@ -280,7 +475,7 @@ HttpResponse HttpClient::request(const wstring& method, const wstring& url, cons
 
                     memset(&proxy_info, 0, sizeof(proxy_info));
 
-                    if (WinHttpGetProxyForUrl(session_handle, url.c_str(), &auto_proxy_options, &proxy_info)) {
+                    if (WinHttpGetProxyForUrl(session_handle, wide_url.c_str(), &auto_proxy_options, &proxy_info)) {
                         if (WinHttpSetOption(request_handle, WINHTTP_OPTION_PROXY, &proxy_info, sizeof(proxy_info))) {
                             if (WinHttpSendRequest(request_handle,
                                 WINHTTP_NO_ADDITIONAL_HEADERS,
@@ -372,29 +567,35 @@ HttpResponse HttpClient::request(const wstring& method, const wstring& url, cons
             WINHTTP_NO_HEADER_INDEX);
 
         if (succeed || (!succeed && (GetLastError() == ERROR_INSUFFICIENT_BUFFER))) {
-            // Allocate memory for the buffer.
-            response.header.resize(remaining_read_size + 1);
+            // Allocate memory for the buffer. The size is reported in bytes, including the NUL terminator.
+            wstring raw_header(remaining_read_size / sizeof(wchar_t), L'\0');
 
             // Now, use WinHttpQueryHeaders to retrieve the header.
             succeed = WinHttpQueryHeaders(request_handle,
                 WINHTTP_QUERY_RAW_HEADERS_CRLF,
                 WINHTTP_HEADER_NAME_BY_INDEX,
-                response.header.data(),
+                raw_header.data(),
                 &remaining_read_size,
                 WINHTTP_NO_HEADER_INDEX);
+
+            if (succeed) {
+                // On success the size excludes the NUL terminator.
+                raw_header.resize(remaining_read_size / sizeof(wchar_t));
+                response.header = utf16_to_utf8(raw_header);
+            }
         }
 
         do {
             remaining_read_size = 0;
-            if (WinHttpQueryDataAvailable(request_handle, &remaining_read_size)) {
-                vector<char> read_buf(remaining_read_size + 1, 0);
+            if (WinHttpQueryDataAvailable(request_handle, &remaining_read_size) && remaining_read_size > 0) {
+                vector<char> read_buf(remaining_read_size, 0);
 
                 dword_t read_size = 0;
                 if (WinHttpReadData(request_handle,
                     read_buf.data(),
                     remaining_read_size,
                     &read_size)) {
-                    response.text += read_buf.data();
+                    response.text.append(read_buf.data(), read_size);
                     response.content_length += read_size;
                 }
             }
@@ -416,29 +617,29 @@ HttpResponse HttpClient::request(const wstring& method, const wstring& url, cons
 }
 
 
-HttpResponse HttpClient::get(const wstring& url, const wstring& extra_header) {
-    return request(L"GET", url, "", extra_header);
+HttpResponse HttpClient::get(const string& url, const string& extra_header) {
+    return request("GET", url, "", extra_header);
 }
 
 
-HttpResponse HttpClient::post(const wstring& url, const string& body, const wstring& extra_header) {
-    return request(L"POST", url, body, extra_header);
+HttpResponse HttpClient::post(const string& url, const string& body, const string& extra_header) {
+    return request("POST", url, body, extra_header);
 }
 
 
 
-HttpResponse HttpClient::put(const wstring& url, const string& body, const wstring& extra_header) {
-    return request(L"PUT", url, body, extra_header);
+HttpResponse HttpClient::put(const string& url, const string& body, const string& extra_header) {
+    return request("PUT", url, body, extra_header);
 }
 
 
-HttpResponse HttpClient::patch(const wstring& url, const string& body, const wstring& extra_header) {
-    return request(L"PATCH", url, body, extra_header);
+HttpResponse HttpClient::patch(const string& url, const string& body, const string& extra_header) {
+    return request("PATCH", url, body, extra_header);
 }
 
 
-HttpResponse HttpClient::delete_(const wstring& url, const string& body, const wstring& extra_header) {
-    return request(L"DELETE", url, body, extra_header);
+HttpResponse HttpClient::delete_(const string& url, const string& body, const string& extra_header) {
+    return request("DELETE", url, body, extra_header);
 }
 
 HttpClient http_client;
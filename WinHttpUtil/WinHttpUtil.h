@@ -9,16 +9,18 @@
 #include <iostream>
 #include <regex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 using std::array;
 using std::regex;
 using std::string;
+using std::string_view;
 using std::unordered_map;
 using std::vector;
-using std::wregex;
 using std::wstring;
+using std::wstring_view;
 
 #include <cstdbool>
 #include <cstdint>
@@ -28,7 +30,32 @@ using bool_t = int;
 using word_t = unsigned long;
 using dword_t = unsigned long;
 using qword_t = unsigned long long;
-using HeaderRecord = unordered_map<wstring, wstring>;
+using HeaderRecord = unordered_map<string, string>;
+
+/// <summary>
+/// Convert UTF-8 to UTF-16 (used at the WinHTTP boundary).
+/// Invalid sequences are replaced with U+FFFD.
+/// </summary>
+/// <param name="input">UTF-8 string</param>
+/// <returns>wstring UTF-16 string</returns>
+wstring utf8_to_utf16(string_view input);
+
+/// <summary>
+/// Convert UTF-16 to UTF-8 (used at the WinHTTP boundary).
+/// Unpaired surrogates are replaced with U+FFFD.
+/// </summary>
+/// <param name="input">UTF-16 string</param>
+/// <returns>string UTF-8 string</returns>
+string utf16_to_utf8(wstring_view input);
+
+/// <summary>
+/// Build the request header sent with every request
+/// </summary>
+/// <param name="url">HTTP url path</param>
+/// <param name="body">Request body</param>
+/// <param name="extra_header">Request header</param>
+/// <returns>string header</returns>
+string build_request_header(const string& url, const string& body, const string& extra_header);
 
 struct HttpResponse {
     /// <summary>
@@ -50,11 +77,11 @@ struct HttpResponse {
     /// <summary>
     /// Get cookies from header (From Set-cookie)
     /// </summary>
-    /// <returns>wstring cookies</returns>
-    wstring cookies();
+    /// <returns>string cookies</returns>
+    string cookies();
 
     string text;
-    wstring header;
+    string header;
     DWORD status_code;
     DWORD content_length;
     string error;
@@ -82,7 +109,7 @@ public:
     /// <param name="proxy_host"></param>
     /// <param name="proxy_username"></param>
     /// <param name="proxy_password"></param>
-    void set_proxy(const wstring& proxy_host, const wstring& proxy_username, const wstring& proxy_password);
+    void set_proxy(const string& proxy_host, const string& proxy_username, const string& proxy_password);
 
     /// <summary>
     /// Whether to use proxy settings
@@ -94,7 +121,7 @@ public:
     /// Set User-agent
     /// </summary>
     /// <param name="user_agent"></param>
-    void set_user_agent(const wstring& user_agent);
+    void set_user_agent(const string& user_agent);
 
     /// <summary>
     /// Get last error code
@@ -110,7 +137,7 @@ public:
     /// <param name="body">Request body</param>
     /// <param name="extra_header">Request header</param>
     /// <returns>HttpResponse response</returns>
-    HttpResponse request(const wstring& method, const wstring& url, const string& body = "", const wstring& extra_header = L"");
+    HttpResponse request(const string& method, const string& url, const string& body = "", const string& extra_header = "");
 
     /// <summary>
     /// Send HTTP GET request
@@ -118,7 +145,7 @@ public:
     /// <param name="url">HTTP url path</param>
     /// <param name="extra_header">Request header</param>
     /// <returns>HttpResponse response</returns>
-    HttpResponse get(const wstring& url, const wstring& extra_header = L"");
+    HttpResponse get(const string& url, const string& extra_header = "");
 
     /// <summary>
     /// Send HTTP POST request
@@ -127,7 +154,7 @@ public:
     /// <param name="body">Request body</param>
     /// <param name="extra_header">Request header</param>
     /// <returns>HttpResponse response</returns>
-    HttpResponse post(const wstring& url, const string& body, const wstring& extra_header = L"");
+    HttpResponse post(const string& url, const string& body, const string& extra_header = "");
 
     /// <summary>
     /// Send HTTP PUT request
@@ -136,7 +163,7 @@ public:
     /// <param name="body">Request body</param>
     /// <param name="extra_header">Request header</param>
     /// <returns>HttpResponse response</returns>
-    HttpResponse put(const wstring& url, const string& body, const wstring& extra_header = L"");
+    HttpResponse put(const string& url, const string& body, const string& extra_header = "");
 
     /// <summary>
     /// Send HTTP PATCH request
@@ -145,7 +172,7 @@ public:
     /// <param name="body">Request body</param>
     /// <param name="extra_header">Request header</param>
     /// <returns>HttpResponse response</returns>
-    HttpResponse patch(const wstring& url, const string& body, const wstring& extra_header = L"");
+    HttpResponse patch(const string& url, const string& body, const string& extra_header = "");
 
     /// <summary>
     /// Send HTTP DELETE request
@@ -154,7 +181,7 @@ public:
     /// <param name="body">Request body</param>
     /// <param name="extra_header">Request header</param>
     /// <returns>HttpResponse response</returns>
-    HttpResponse delete_(const wstring& url, const string& body, const wstring& extra_header = L"");
+    HttpResponse delete_(const string& url, const string& body, const string& extra_header = "");
 
 private:
     bool_t _use_proxy;
@@ -1,6 +1,8 @@
 ﻿#include "WinHttpUtil.h"
 
+#include <chrono>
 #include <clocale>
+#include <cstring>
 
 const char post_data[] = R"({
     "foo": "bar",
@@ -8,15 +10,187 @@ const char post_data[] = R"({
     "users": ["lance", "ck19"]
 })";
 
-const wchar_t header[] = LR"(Content-Type: application/json
+const char header[] = R"(Content-Type: application/json
 accept: application/json)";
 
-int main() {
+struct BenchRequest {
+    const char* name;
+    string url;
+    string extra_header;
+    wstring response_header;
+};
+
+const BenchRequest bench_requests[] = {
+    {
+        "ascii",
+        "https://httpbin.org/post?user=lance&lang=zh-CN",
+        header,
+        L"HTTP/1.1 200 OK\r\n"
+        L"Connection: keep-alive\r\n"
+        L"Date: Sat, 18 Oct 2026 00:00:00 GMT\r\n"
+        L"Content-Type: application/json\r\n"
+        L"Content-Length: 512\r\n"
+        L"Server: gunicorn/19.9.0\r\n"
+        L"Set-Cookie: session=0123456789abcdef; Path=/; HttpOnly\r\n"
+        L"Access-Control-Allow-Origin: *\r\n"
+        L"Access-Control-Allow-Credentials: true\r\n\r\n",
+    },
+    {
+        // CJK query and header values (U+84DD U+8272, U+4E2D U+6587, U+62A5 U+544A)
+        "cjk",
+        "https://httpbin.org/post?user=\xE8\x93\x9D\xE8\x89\xB2&lang=\xE4\xB8\xAD\xE6\x96\x87",
+        string(header) + "\r\nX-Nickname: \xE8\x93\x9D\xE8\x89\xB2",
+        L"HTTP/1.1 200 OK\r\n"
+        L"Connection: keep-alive\r\n"
+        L"Date: Sat, 18 Oct 2026 00:00:00 GMT\r\n"
+        L"Content-Type: application/json\r\n"
+        L"Content-Disposition: attachment; filename=\"\x62A5\x544A.json\"\r\n"
+        L"Content-Length: 512\r\n"
+        L"Server: gunicorn/19.9.0\r\n"
+        L"Set-Cookie: nickname=\x84DD\x8272; Path=/; HttpOnly\r\n"
+        L"Access-Control-Allow-Origin: *\r\n"
+        L"Access-Control-Allow-Credentials: true\r\n\r\n",
+    },
+};
+
+/// <summary>
+/// UTF-8 to UTF-16 with the Win32 converter, for comparison
+/// </summary>
+wstring win32_utf8_to_utf16(string_view input) {
+    if (input.empty()) {
+        return L"";
+    }
+    const int size = MultiByteToWideChar(CP_UTF8, 0, input.data(), static_cast<int>(input.size()), nullptr, 0);
+    wstring output(size, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, input.data(), static_cast<int>(input.size()), output.data(), size);
+    return output;
+}
+
+/// <summary>
+/// UTF-16 to UTF-8 with the Win32 converter, for comparison
+/// </summary>
+string win32_utf16_to_utf8(wstring_view input) {
+    if (input.empty()) {
+        return "";
+    }
+    const int size = WideCharToMultiByte(CP_UTF8, 0, input.data(), static_cast<int>(input.size()), nullptr, 0, nullptr, nullptr);
+    string output(size, '\0');
+    WideCharToMultiByte(CP_UTF8, 0, input.data(), static_cast<int>(input.size()), output.data(), size, nullptr, nullptr);
+    return output;
+}
+
+/// <summary>
+/// Time the conversions done at the WinHTTP boundary of one request
+/// (method, url, request header in; response header out)
+/// </summary>
+template <typename ToUtf16, typename ToUtf8>
+void benchmark_transcode_with(const char* converter_name, const BenchRequest& bench, ToUtf16 to_utf16, ToUtf8 to_utf8) {
+    using namespace std;
+    using clock = chrono::steady_clock;
+
+    constexpr size_t iterations = 1000000;
+    const string request_header = build_request_header(bench.url, post_data, bench.extra_header);
+    size_t checksum = 0;
+
+    const auto start = clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        checksum += to_utf16("POST").size();
+        checksum += to_utf16(bench.url).size();
+        checksum += to_utf16(request_header).size();
+        checksum += to_utf8(bench.response_header).size();
+    }
+    const auto elapsed = chrono::duration_cast<chrono::nanoseconds>(clock::now() - start);
+
+    cout << format("transcode {:<5} {:<6}: {:.1f} ns/request (checksum {})",
+        bench.name, converter_name, static_cast<double>(elapsed.count()) / iterations, checksum) << endl;
+}
+
+/// <summary>
+/// Compare the per-request conversion cost against the Win32 converters
+/// </summary>
+void benchmark_transcode() {
+    for (const auto& bench : bench_requests) {
+        benchmark_transcode_with("util", bench, utf8_to_utf16, utf16_to_utf8);
+        benchmark_transcode_with("win32", bench, win32_utf8_to_utf16, win32_utf16_to_utf8);
+    }
+}
+
+/// <summary>
+/// Check utf8_to_utf16 / utf16_to_utf8 against known conversions
+/// </summary>
+/// <returns>bool all checks passed</returns>
+bool selftest_transcode() {
     using namespace std;
 
+    size_t failures = 0;
+    const auto check = [&failures](bool passed, const string& name) {
+        if (!passed) {
+            ++failures;
+            cout << "FAILED: " << name << endl;
+        }
+    };
+
+    // ASCII runs around the 16-unit SIMD boundary with a non-ASCII tail (U+00E9, U+4E2D, U+1F600)
+    const string tail_utf8 = "\xC3\xA9" "\xE4\xB8\xAD" "\xF0\x9F\x98\x80";
+    const wstring tail_utf16 = L"\x00E9" L"\x4E2D" L"\xD83D\xDE00";
+    for (const size_t n : { 0, 1, 15, 16, 17, 31, 32, 33 }) {
+        const string utf8 = string(n, 'a') + tail_utf8 + string(40, 'b');
+        const wstring utf16 = wstring(n, L'a') + tail_utf16 + wstring(40, L'b');
+        check(utf8_to_utf16(utf8) == utf16, format("utf8_to_utf16 round trip, {} ASCII prefix", n));
+        check(utf16_to_utf8(utf16) == utf8, format("utf16_to_utf8 round trip, {} ASCII prefix", n));
+    }
+
+    // Surrogate pairs
+    check(utf8_to_utf16("\xF0\x9F\x98\x80") == L"\xD83D\xDE00", "utf8_to_utf16 U+1F600");
+    check(utf16_to_utf8(L"\xD83D\xDE00") == "\xF0\x9F\x98\x80", "utf16_to_utf8 U+1F600");
+    check(utf8_to_utf16("\xF4\x8F\xBF\xBF") == L"\xDBFF\xDFFF", "utf8_to_utf16 U+10FFFF");
+    check(utf16_to_utf8(L"\xDBFF\xDFFF") == "\xF4\x8F\xBF\xBF", "utf16_to_utf8 U+10FFFF");
+
+    // Unpaired surrogates become U+FFFD
+    const string replacement = "\xEF\xBF\xBD";
+    check(utf16_to_utf8(L"a\xD800" L"b") == "a" + replacement + "b", "utf16_to_utf8 lone high surrogate");
+    check(utf16_to_utf8(L"a\xDC00" L"b") == "a" + replacement + "b", "utf16_to_utf8 lone low surrogate");
+    check(utf16_to_utf8(L"\xDC00\xD800") == replacement + replacement, "utf16_to_utf8 reversed surrogate pair");
+    check(utf16_to_utf8(L"x\xD83D") == "x" + replacement, "utf16_to_utf8 truncated surrogate pair");
+    check(utf16_to_utf8(wstring(20, L'a') + L"\xD800") == string(20, 'a') + replacement, "utf16_to_utf8 lone surrogate after SIMD run");
+
+    // Malformed UTF-8 becomes one U+FFFD per rejected byte
+    const struct {
+        const char* name;
+        string input;
+        wstring expected;
+    } malformed[] = {
+        { "overlong", "\xC0\xAF", L"\xFFFD\xFFFD" },
+        { "truncated", "\xE4\xB8", L"\xFFFD\xFFFD" },
+        { "truncated before ASCII", "\xE4\xB8" "a", L"\xFFFD\xFFFD" L"a" },
+        { "stray continuation", "a\x80" "b", L"a\xFFFD" L"b" },
+        { "encoded surrogate", "\xED\xA0\x80", L"\xFFFD\xFFFD\xFFFD" },
+        { "above U+10FFFF", "\xF4\x90\x80\x80", L"\xFFFD\xFFFD\xFFFD\xFFFD" },
+        { "invalid lead byte", "\xFF", L"\xFFFD" },
+    };
+    for (const auto& item : malformed) {
+        check(utf8_to_utf16(item.input) == item.expected, format("utf8_to_utf16 {}", item.name));
+    }
+
+    cout << format("transcode selftest: {} failures", failures) << endl;
+    return failures == 0;
+}
+
+int main(int argc, char* argv[]) {
+    using namespace std;
+
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        benchmark_transcode();
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--selftest") == 0) {
+        return selftest_transcode() ? 0 : 1;
+    }
+
     cout << "Current locale is: " << setlocale(LC_ALL, "Chinese-simplified") << endl;
 
-    const auto& resp = http_client.post(L"https://httpbin.org/post", post_data, header);
+    const auto& resp = http_client.post("https://httpbin.org/post", post_data, header);
 
     if (resp.status_code == 200) {
         cout << resp.text << endl;